@@ -1,7 +1,91 @@
 #include "dkedlist.h"
 #include "dkedlist_codes.h"
+#include "dkedlist_internal.h"
 #include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
 #include <assert.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#ifndef DKEDLIST_INLINE_NODES
+#define DKEDLIST_INLINE_NODES 3
+#endif
+
+// Lists are allocated together with their state placed right before them
+// and their inline nodes placed right after them
+#define LIST_ALLOC_SIZE(inline_size) (sizeof(struct _dkedlist_state_) + sizeof(struct _dkedlist_) + (inline_size) * sizeof(struct _dkedlist_node_))
+#define STATE(list) ((struct _dkedlist_state_ *)(list) - 1)
+#define INLINE_NODES(list) ((struct _dkedlist_node_ *)((list) + 1))
+
+#ifndef DKEDLIST_MERGE_STACK
+#define DKEDLIST_MERGE_STACK 32
+#endif
+
+#ifndef DKEDLIST_MAX_LANES
+#define DKEDLIST_MAX_LANES 16
+#endif
+
+#if defined(__GNUC__) && !defined(DKEDLIST_NO_PREFETCH)
+#define _dkedlist_prefetch_(addr) __builtin_prefetch((addr), 0, 3)
+#else
+#define _dkedlist_prefetch_(addr) ((void)(addr))
+#endif
+
+/**
+ * @brief Bookkeeping of a list, kept right before it in the same allocation
+ * so the list itself only holds the fields walks need.
+ *
+ */
+struct _dkedlist_state_
+{
+    unsigned long free_size;            // Numbers of unused nodes ready to be reused.
+    struct _dkedlist_node_ *free_nodes; // Unused nodes, linked through their next pointer.
+    struct _dkedlist_chunk_ *chunks;    // Bulk allocations of nodes owned by the list.
+    struct _dkedlist_index_ *index;     // Express lanes kept by sorted lists. NULL for other lists.
+    unsigned long inline_size;          // Numbers of nodes allocated together with the list.
+    struct _dkedlist_ *reclaim_next;    // The next list waiting to be reclaimed, while queued by dkedlist_destroy_deferred.
+};
+
+/**
+ * @brief A single allocation holding several nodes owned by a list.
+ * Nodes taken from it are never freed one by one: once removed they go
+ * back to the list's free nodes, and the whole chunk is released when
+ * the list is destroyed.
+ *
+ */
+struct _dkedlist_chunk_
+{
+    struct _dkedlist_chunk_ *next;   // The next chunk owned by the same list (if any).
+    unsigned long count;             // Numbers of nodes in the chunk.
+    struct _dkedlist_node_ nodes[];  // The nodes themselves.
+};
+
+/**
+ * @brief Express lane entry of a sorted list. Each one sits on top of a
+ * node and links it to the next entry at every lane it belongs to,
+ * letting searches skip whole runs of the prev/next chain.
+ *
+ */
+struct _dkedlist_lane_
+{
+    struct _dkedlist_node_ *node;     // The node this entry sits on top of.
+    unsigned int height;              // Numbers of lanes this entry belongs to.
+    struct _dkedlist_lane_ *next[];   // The next entry at every lane (if any).
+};
+
+/**
+ * @brief Skip list layered over the nodes of a sorted list.
+ *
+ */
+struct _dkedlist_index_
+{
+    int (*compare)(void *a, void *b);                 // Function defining the order of the list.
+    unsigned int lanes;                               // Numbers of lanes in use.
+    unsigned int seed;                                // State used to pick the height of new entries.
+    struct _dkedlist_lane_ *head[DKEDLIST_MAX_LANES]; // The first entry at every lane (if any).
+};
 
 void _custom_dealloc_(unsigned long size, void *ptr)
 {
@@ -10,40 +94,352 @@ void _custom_dealloc_(unsigned long size, void *ptr)
 
 static void *(*dkedlist_allocate)(unsigned long size) = malloc;
 static void (*dkedlist_deallocte)(unsigned long size, void *ptr) = _custom_dealloc_;
+#ifndef DKEDLIST_NO_PREFETCH
+// Read by walks on any thread, including the reclaimer, while dkedlist_set_prefetch may write it
+static atomic_char prefetch_enabled = 0;
+#endif
+
+// Lists handed to dkedlist_destroy_deferred waiting to be reclaimed, linked
+// through their reclaim_next. Lists taken out of the queue by a step are in flight.
+static pthread_mutex_t reclaim_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t reclaim_cond = PTHREAD_COND_INITIALIZER;
+static struct _dkedlist_ *reclaim_queue = NULL;
+static struct _dkedlist_ *reclaim_queue_last = NULL;
+static unsigned long reclaim_pending = 0;
+static unsigned long reclaim_in_flight = 0;
+static unsigned long reclaim_limit = 0;
+static char reclaimer_running = 0;
+static char reclaimer_stopping = 0;
+static unsigned long reclaimer_budget = 0;
+static pthread_t reclaimer;
+
+char _prefetch_enabled_(void)
+{
+#ifdef DKEDLIST_NO_PREFETCH
+    return 0;
+#else
+    return atomic_load_explicit(&prefetch_enabled, memory_order_relaxed);
+#endif
+}
+
+void _prefetch_next_(char with_data, struct _dkedlist_node_ *next)
+{
+    if (!next || !_prefetch_enabled_())
+    {
+        return;
+    }
+
+    // Issued before the current node is processed, to overlap with that work
+    _dkedlist_prefetch_(next->next);
+
+    if (with_data)
+    {
+        _dkedlist_prefetch_(next->data);
+    }
+}
 
-int _create_list_(void (*destroy_data)(void *data), struct _dkedlist_ **out_list)
+int _create_list_(unsigned long inline_size, void (*destroy_data)(void *data), struct _dkedlist_ **out_list)
 {
     assert((out_list || *out_list) && "out_list can't be NULL");
 
-    struct _dkedlist_ *list = (struct _dkedlist_ *)dkedlist_allocate(sizeof(struct _dkedlist_));
+    struct _dkedlist_state_ *state = (struct _dkedlist_state_ *)dkedlist_allocate(LIST_ALLOC_SIZE(inline_size));
 
-    if (!list)
+    if (!state)
     {
         return DKEDLIST_ERR_ALLOC;
     }
 
+    struct _dkedlist_ *list = (struct _dkedlist_ *)(state + 1);
+
     list->size = 0;
     list->head = NULL;
     list->tail = NULL;
     list->destroy_data = destroy_data;
+    STATE(list)->free_size = 0;
+    STATE(list)->free_nodes = NULL;
+    STATE(list)->chunks = NULL;
+    STATE(list)->index = NULL;
+    STATE(list)->inline_size = inline_size;
+    STATE(list)->reclaim_next = NULL;
+
+    struct _dkedlist_node_ *inline_nodes = INLINE_NODES(list);
+
+    // Pushed in reverse so nodes are handed out in address order
+    for (unsigned long i = inline_size; i > 0; i--)
+    {
+        struct _dkedlist_node_ *node = &inline_nodes[i - 1];
+
+        node->list = NULL;
+        node->next = STATE(list)->free_nodes;
+        STATE(list)->free_nodes = node;
+        STATE(list)->free_size++;
+    }
 
     *out_list = list;
 
     return DKEDLIST_OK;
 }
 
+int _reserve_nodes_(unsigned long count, struct _dkedlist_ *list)
+{
+    if (count <= STATE(list)->free_size)
+    {
+        return DKEDLIST_OK;
+    }
+
+    unsigned long missing = count - STATE(list)->free_size;
+
+    if (missing > (ULONG_MAX - sizeof(struct _dkedlist_chunk_)) / sizeof(struct _dkedlist_node_))
+    {
+        return DKEDLIST_ERR_ALLOC;
+    }
+
+    struct _dkedlist_chunk_ *chunk = (struct _dkedlist_chunk_ *)dkedlist_allocate(sizeof(struct _dkedlist_chunk_) + missing * sizeof(struct _dkedlist_node_));
+
+    if (!chunk)
+    {
+        return DKEDLIST_ERR_ALLOC;
+    }
+
+    chunk->count = missing;
+    chunk->next = STATE(list)->chunks;
+    STATE(list)->chunks = chunk;
+
+    // Pushed in reverse so nodes are handed out in address order
+    for (unsigned long i = missing; i > 0; i--)
+    {
+        struct _dkedlist_node_ *node = &chunk->nodes[i - 1];
+
+        node->list = NULL;
+        node->next = STATE(list)->free_nodes;
+        STATE(list)->free_nodes = node;
+    }
+
+    STATE(list)->free_size += missing;
+
+    return DKEDLIST_OK;
+}
+
+char _is_inline_(struct _dkedlist_ *list, struct _dkedlist_node_ *node)
+{
+    uintptr_t address = (uintptr_t)node;
+    uintptr_t start = (uintptr_t)INLINE_NODES(list);
+
+    return address >= start && address < start + STATE(list)->inline_size * sizeof(struct _dkedlist_node_);
+}
+
+void _release_node_(struct _dkedlist_ *list, struct _dkedlist_node_ *node)
+{
+    // Unused nodes don't belong to any list, which tells them apart from live inline ones
+    node->list = NULL;
+    node->prev = NULL;
+    node->next = STATE(list)->free_nodes;
+    STATE(list)->free_nodes = node;
+    STATE(list)->free_size++;
+}
+
+void _destroy_chunks_(struct _dkedlist_ *list)
+{
+    struct _dkedlist_chunk_ *chunk = STATE(list)->chunks;
+
+    while (chunk)
+    {
+        struct _dkedlist_chunk_ *next = chunk->next;
+
+        dkedlist_deallocte(sizeof(struct _dkedlist_chunk_) + chunk->count * sizeof(struct _dkedlist_node_), chunk);
+
+        chunk = next;
+    }
+
+    STATE(list)->chunks = NULL;
+    STATE(list)->free_nodes = NULL;
+    STATE(list)->free_size = 0;
+}
+
+int _create_index_(int (*compare)(void *a, void *b), struct _dkedlist_ *list)
+{
+    struct _dkedlist_index_ *index = (struct _dkedlist_index_ *)dkedlist_allocate(sizeof(struct _dkedlist_index_));
+
+    if (!index)
+    {
+        return DKEDLIST_ERR_ALLOC;
+    }
+
+    index->compare = compare;
+    index->lanes = 0;
+    index->seed = 2463534242u;
+
+    for (unsigned int i = 0; i < DKEDLIST_MAX_LANES; i++)
+    {
+        index->head[i] = NULL;
+    }
+
+    STATE(list)->index = index;
+
+    return DKEDLIST_OK;
+}
+
+#define LANE_SIZE(height) (sizeof(struct _dkedlist_lane_) + (height) * sizeof(struct _dkedlist_lane_ *))
+
+struct _dkedlist_lane_ **_lane_link_(struct _dkedlist_index_ *index, struct _dkedlist_lane_ *lane, unsigned int level)
+{
+    return lane ? &lane->next[level] : &index->head[level];
+}
+
+unsigned int _random_height_(struct _dkedlist_index_ *index)
+{
+    unsigned int x = index->seed;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+
+    index->seed = x;
+
+    // Every lane holds about a quarter of the entries of the one below it
+    unsigned int height = 0;
+
+    while ((x & 3) == 0 && height < DKEDLIST_MAX_LANES)
+    {
+        height++;
+        x >>= 2;
+    }
+
+    return height;
+}
+
+struct _dkedlist_node_ *_search_(char inclusive, void *key, struct _dkedlist_ *list, struct _dkedlist_lane_ **preds)
+{
+    struct _dkedlist_index_ *index = STATE(list)->index;
+    struct _dkedlist_lane_ *lane = NULL;
+
+    for (unsigned int level = DKEDLIST_MAX_LANES; level > 0; level--)
+    {
+        if (level <= index->lanes)
+        {
+            struct _dkedlist_lane_ *next = *_lane_link_(index, lane, level - 1);
+
+            while (next)
+            {
+                int order = index->compare(next->node->data, key);
+
+                if (order > 0 || (order == 0 && !inclusive))
+                {
+                    break;
+                }
+
+                lane = next;
+                next = next->next[level - 1];
+            }
+        }
+
+        if (preds)
+        {
+            preds[level - 1] = lane;
+        }
+    }
+
+    struct _dkedlist_node_ *node = lane ? lane->node->next : list->head;
+
+    while (node)
+    {
+        int order = index->compare(node->data, key);
+
+        if (order > 0 || (order == 0 && !inclusive))
+        {
+            break;
+        }
+
+        node = node->next;
+    }
+
+    return node;
+}
+
+void _unlink_lanes_(struct _dkedlist_node_ *node, struct _dkedlist_ *list)
+{
+    struct _dkedlist_index_ *index = STATE(list)->index;
+    struct _dkedlist_lane_ *lane = NULL;
+    struct _dkedlist_lane_ *found = NULL;
+
+    for (unsigned int level = index->lanes; level > 0; level--)
+    {
+        struct _dkedlist_lane_ **link = _lane_link_(index, lane, level - 1);
+
+        while (*link && index->compare((*link)->node->data, node->data) < 0)
+        {
+            lane = *link;
+            link = &lane->next[level - 1];
+        }
+
+        // Entries with the same key keep the order of their nodes, so look past them
+        while (*link && (*link)->node != node && index->compare((*link)->node->data, node->data) == 0)
+        {
+            link = &(*link)->next[level - 1];
+        }
+
+        if (*link && (*link)->node == node)
+        {
+            found = *link;
+            *link = found->next[level - 1];
+        }
+    }
+
+    while (index->lanes > 0 && !index->head[index->lanes - 1])
+    {
+        index->lanes--;
+    }
+
+    if (found)
+    {
+        dkedlist_deallocte(LANE_SIZE(found->height), found);
+    }
+}
+
+void _clear_lanes_(struct _dkedlist_ *list)
+{
+    struct _dkedlist_index_ *index = STATE(list)->index;
+    struct _dkedlist_lane_ *lane = index->lanes ? index->head[0] : NULL;
+
+    while (lane)
+    {
+        struct _dkedlist_lane_ *next = lane->next[0];
+
+        dkedlist_deallocte(LANE_SIZE(lane->height), lane);
+
+        lane = next;
+    }
+
+    for (unsigned int i = 0; i < index->lanes; i++)
+    {
+        index->head[i] = NULL;
+    }
+
+    index->lanes = 0;
+}
+
 int _create_node_(void *data, struct _dkedlist_ *list, struct _dkedlist_node_ **out_node)
 {
     assert(list && "list can't be NULL");
     assert(out_node || *out_node && "out_node can't be NULL");
 
-    struct _dkedlist_node_ *node = (struct _dkedlist_node_ *)dkedlist_allocate(sizeof(struct _dkedlist_node_));
+    struct _dkedlist_node_ *node = STATE(list)->free_nodes;
 
+    // Every node comes from the list's own storage, which grows geometrically so
+    // the chunks stay few and releasing a node never has to look for its owner
     if (!node)
     {
-        return DKEDLIST_ERR_ALLOC;
+        if (_reserve_nodes_(list->size ? list->size : 1, list))
+        {
+            return DKEDLIST_ERR_ALLOC;
+        }
+
+        node = STATE(list)->free_nodes;
     }
 
+    STATE(list)->free_nodes = node->next;
+    STATE(list)->free_size--;
+
     node->prev = NULL;
     node->next = NULL;
     node->list = list;
@@ -60,25 +456,27 @@ int _remove_node_(char clean_up, struct _dkedlist_node_ *node)
 
     struct _dkedlist_ *list = node->list;
 
-    if (node == list->head)
+    if (STATE(list)->index)
     {
-        list->head = node->next;
+        _unlink_lanes_(node, list);
     }
-    else if (node == list->tail)
+
+    if (node->prev)
     {
-        list->tail = node->prev;
+        node->prev->next = node->next;
     }
     else
     {
-        if (node->prev)
-        {
-            node->prev->next = node->next;
-        }
+        list->head = node->next;
+    }
 
-        if (node->next)
-        {
-            node->next->prev = node->prev;
-        }
+    if (node->next)
+    {
+        node->next->prev = node->prev;
+    }
+    else
+    {
+        list->tail = node->prev;
     }
 
     if (clean_up)
@@ -94,7 +492,7 @@ int _remove_node_(char clean_up, struct _dkedlist_node_ *node)
     node->prev = NULL;
     node->list = NULL;
 
-    dkedlist_deallocte(sizeof(struct _dkedlist_node_), node);
+    _release_node_(list, node);
 
     list->size = list->size - 1;
 
@@ -109,16 +507,35 @@ int _remove_node_(char clean_up, struct _dkedlist_node_ *node)
 
 int _remove_all_nodes_(char clean_up, struct _dkedlist_ *list)
 {
+    char destroy = clean_up && list->destroy_data;
     struct _dkedlist_node_ *current = list->head;
 
+    if (STATE(list)->index)
+    {
+        _clear_lanes_(list);
+    }
+
     while (current)
     {
         struct _dkedlist_node_ *next = current->next;
 
-        _remove_node_(clean_up, current);
+        _prefetch_next_(destroy, next);
+
+        if (destroy)
+        {
+            list->destroy_data(current->data);
+        }
+
+        _release_node_(list, current);
 
         current = next;
     }
+
+    list->size = 0;
+    list->head = NULL;
+    list->tail = NULL;
+
+    return DKEDLIST_OK;
 }
 
 void _destroy_list_(int clean_up, struct _dkedlist_ **list)
@@ -128,147 +545,887 @@ void _destroy_list_(int clean_up, struct _dkedlist_ **list)
         return;
     }
 
-    _remove_all_nodes_(clean_up, *list);
+    char destroy = clean_up && (*list)->destroy_data;
+    struct _dkedlist_node_ *current = (*list)->head;
+
+    if (STATE(*list)->index)
+    {
+        _clear_lanes_(*list);
+        dkedlist_deallocte(sizeof(struct _dkedlist_index_), STATE(*list)->index);
+    }
+
+    // Nodes go away with the chunks, so they are only visited to destroy their data
+    while (destroy && current)
+    {
+        struct _dkedlist_node_ *next = current->next;
+
+        _prefetch_next_(1, next);
+
+        (*list)->destroy_data(current->data);
+
+        current = next;
+    }
+
+    _destroy_chunks_(*list);
 
+    STATE(*list)->index = NULL;
     (*list)->destroy_data = NULL;
     (*list)->head = NULL;
     (*list)->tail = NULL;
     (*list)->size = 0;
 
-    dkedlist_deallocte(sizeof(struct _dkedlist_), *list);
+    dkedlist_deallocte(LIST_ALLOC_SIZE(STATE(*list)->inline_size), STATE(*list));
 
     *list = NULL;
 }
 
-int _validate_iter_(struct _dkedlist_iter_ iterator)
+int _defer_list_(char clean_up, struct _dkedlist_ **list)
 {
-    struct _dkedlist_ *list = iterator.list;
-
-    if (list->size == 0)
-    {
-        return 0;
-    }
-
-    if (iterator.initialized)
-    {
-        return 1;
-    }
-
-    if (iterator.forward && iterator.current_indx >= list->size - 1)
+    if (!list || !(*list))
     {
-        return 0;
+        return DKEDLIST_OK;
     }
 
-    if (!iterator.forward && iterator.current_indx == 0)
-    {
-        return 0;
-    }
+    struct _dkedlist_ *detached = *list;
 
-    return 1;
-}
+    pthread_mutex_lock(&reclaim_lock);
 
-void dkedlist_set_malloc(void *(*dkedlist_malloc)(unsigned long size))
-{
-    if (dkedlist_malloc)
+    if (reclaim_limit && reclaim_pending >= reclaim_limit)
     {
-        dkedlist_allocate = dkedlist_malloc;
-        return;
+        pthread_mutex_unlock(&reclaim_lock);
+        return DKEDLIST_ERR_BUSY;
     }
 
-    dkedlist_allocate = malloc;
-}
-
-void dkedlist_set_free(void (*dkedlist_free)(unsigned long size, void *ptr))
-{
-    if (dkedlist_free)
+    if (!clean_up)
     {
-        dkedlist_deallocte = dkedlist_free;
-        return;
+        detached->destroy_data = NULL;
     }
 
-    dkedlist_deallocte = _custom_dealloc_;
-}
+    STATE(detached)->reclaim_next = NULL;
 
-void dkedlist_iter_create(char forward, struct _dkedlist_iter_ *iterator, struct _dkedlist_ *list)
-{
-    if (forward)
+    if (reclaim_queue_last)
     {
-        iterator->current_indx = 0;
+        STATE(reclaim_queue_last)->reclaim_next = detached;
     }
     else
     {
-        iterator->current_indx = list->size - 1;
+        reclaim_queue = detached;
     }
 
-    iterator->initialized = 1;
-    iterator->current_node = NULL;
-    iterator->forward = forward;
-    iterator->list = list;
-}
+    reclaim_queue_last = detached;
+    reclaim_pending += detached->size;
 
-int dkedlist_iter_has_next(struct _dkedlist_iter_ iterator)
-{
-    return _validate_iter_(iterator);
+    pthread_cond_broadcast(&reclaim_cond);
+    pthread_mutex_unlock(&reclaim_lock);
+
+    *list = NULL;
+
+    return DKEDLIST_OK;
 }
 
-struct _dkedlist_node_ *dkedlist_iter_next(struct _dkedlist_iter_ *iterator)
+char _reclaim_list_(unsigned long *budget, unsigned long *out_nodes, struct _dkedlist_ *list)
 {
-    struct _dkedlist_ *list = iterator->list;
+    struct _dkedlist_index_ *index = STATE(list)->index;
 
-    int has_next = _validate_iter_(*iterator);
+    // Lane entries are released first, each one counting against the budget
+    if (index)
+    {
+        struct _dkedlist_lane_ *lane = index->lanes ? index->head[0] : NULL;
+
+        while (lane && *budget > 0)
+        {
+            struct _dkedlist_lane_ *next = lane->next[0];
+
+            dkedlist_deallocte(LANE_SIZE(lane->height), lane);
+
+            (*budget)--;
+            lane = next;
+        }
+
+        if (lane)
+        {
+            index->head[0] = lane;
+            *out_nodes = 0;
+
+            return 0;
+        }
+
+        dkedlist_deallocte(sizeof(struct _dkedlist_index_), index);
+        STATE(list)->index = NULL;
+    }
+
+    struct _dkedlist_node_ *current = list->head;
+    unsigned long reclaimed = 0;
+
+    if (list->destroy_data)
+    {
+        while (current && reclaimed < *budget)
+        {
+            struct _dkedlist_node_ *next = current->next;
+
+            _prefetch_next_(1, next);
+
+            list->destroy_data(current->data);
+
+            reclaimed++;
+            current = next;
+        }
+
+        *budget -= reclaimed;
+    }
+    else
+    {
+        // Nodes go away with the chunks, so there's nothing to do for each of them
+        reclaimed = list->size;
+        current = NULL;
+    }
+
+    list->head = current;
+    list->size -= reclaimed;
+    *out_nodes = reclaimed;
+
+    if (current)
+    {
+        return 0;
+    }
+
+    // Chunks are released one by one, each one counting against the budget
+    while (STATE(list)->chunks && *budget > 0)
+    {
+        struct _dkedlist_chunk_ *chunk = STATE(list)->chunks;
+
+        STATE(list)->chunks = chunk->next;
+        dkedlist_deallocte(sizeof(struct _dkedlist_chunk_) + chunk->count * sizeof(struct _dkedlist_node_), chunk);
+
+        (*budget)--;
+    }
+
+    if (STATE(list)->chunks)
+    {
+        return 0;
+    }
+
+    dkedlist_deallocte(LIST_ALLOC_SIZE(STATE(list)->inline_size), STATE(list));
+
+    return 1;
+}
+
+unsigned long _reclaim_step_(unsigned long budget)
+{
+    pthread_mutex_lock(&reclaim_lock);
+
+    while (budget > 0 && reclaim_queue)
+    {
+        // Taken out of the queue so concurrent callers never share a list
+        struct _dkedlist_ *list = reclaim_queue;
+        unsigned long reclaimed = 0;
+
+        reclaim_queue = STATE(list)->reclaim_next;
+        reclaim_in_flight++;
+
+        if (!reclaim_queue)
+        {
+            reclaim_queue_last = NULL;
+        }
+
+        pthread_mutex_unlock(&reclaim_lock);
+
+        char finished = _reclaim_list_(&budget, &reclaimed, list);
+
+        pthread_mutex_lock(&reclaim_lock);
+
+        reclaim_pending -= reclaimed;
+        reclaim_in_flight--;
+
+        // Wakes up drains waiting for the list to be released or requeued
+        pthread_cond_broadcast(&reclaim_cond);
+
+        if (!finished)
+        {
+            STATE(list)->reclaim_next = reclaim_queue;
+            reclaim_queue = list;
+
+            if (!reclaim_queue_last)
+            {
+                reclaim_queue_last = list;
+            }
+        }
+    }
+
+    // Queued lists without nodes left still need a step to be released
+    unsigned long pending = reclaim_queue ? reclaim_pending + 1 : 0;
+
+    pthread_mutex_unlock(&reclaim_lock);
+
+    return pending;
+}
+
+void *_reclaimer_loop_(void *arg)
+{
+    (void)arg;
+
+    pthread_mutex_lock(&reclaim_lock);
+
+    while (reclaimer_running)
+    {
+        if (!reclaim_queue)
+        {
+            pthread_cond_wait(&reclaim_cond, &reclaim_lock);
+            continue;
+        }
+
+        unsigned long budget = reclaimer_budget ? reclaimer_budget : (unsigned long)-1;
+
+        pthread_mutex_unlock(&reclaim_lock);
+
+        _reclaim_step_(budget);
+
+        pthread_mutex_lock(&reclaim_lock);
+    }
+
+    pthread_mutex_unlock(&reclaim_lock);
+
+    return NULL;
+}
+
+void _gather_(struct _dkedlist_ *list, void **array)
+{
+    struct _dkedlist_node_ *current = list->head;
+    unsigned long remaining = list->size;
+
+    while (remaining >= 4)
+    {
+        _prefetch_next_(0, current->next);
+        array[0] = current->data;
+        current = current->next;
+
+        _prefetch_next_(0, current->next);
+        array[1] = current->data;
+        current = current->next;
+
+        _prefetch_next_(0, current->next);
+        array[2] = current->data;
+        current = current->next;
+
+        _prefetch_next_(0, current->next);
+        array[3] = current->data;
+        current = current->next;
+
+        array += 4;
+        remaining -= 4;
+    }
+
+    while (remaining > 0)
+    {
+        *array++ = current->data;
+        current = current->next;
+        remaining--;
+    }
+}
+
+void _append_reserved_(void **array, unsigned long count, struct _dkedlist_ *list)
+{
+    assert(count <= STATE(list)->free_size && "nodes must be reserved first");
+
+    struct _dkedlist_node_ *tail = list->tail;
+    struct _dkedlist_node_ *node = STATE(list)->free_nodes;
+
+    for (unsigned long i = 0; i < count; i++)
+    {
+        struct _dkedlist_node_ *next = node->next;
+
+        node->prev = tail;
+        node->next = NULL;
+        node->list = list;
+        node->data = array[i];
+
+        if (tail)
+        {
+            tail->next = node;
+        }
+        else
+        {
+            list->head = node;
+        }
+
+        tail = node;
+        node = next;
+    }
+
+    STATE(list)->free_nodes = node;
+    STATE(list)->free_size -= count;
+    list->tail = tail;
+    list->size += count;
+}
+
+/**
+ * @brief Position of the merge inside one of the input lists.
+ *
+ */
+struct _merge_cursor_
+{
+    struct _dkedlist_node_ *node; // The next node to merge from the input.
+    unsigned long source;         // Index of the input, used to keep the merge stable.
+};
+
+char _merge_before_(int (*compare)(void *a, void *b), struct _merge_cursor_ *a, struct _merge_cursor_ *b)
+{
+    int order = compare(a->node->data, b->node->data);
+
+    return order < 0 || (order == 0 && a->source < b->source);
+}
+
+void _sift_down_(int (*compare)(void *a, void *b), struct _merge_cursor_ *heap, unsigned long size, unsigned long i)
+{
+    struct _merge_cursor_ cursor = heap[i];
+
+    for (;;)
+    {
+        unsigned long child = i * 2 + 1;
+
+        if (child >= size)
+        {
+            break;
+        }
+
+        if (child + 1 < size && _merge_before_(compare, &heap[child + 1], &heap[child]))
+        {
+            child++;
+        }
+
+        if (!_merge_before_(compare, &heap[child], &cursor))
+        {
+            break;
+        }
+
+        heap[i] = heap[child];
+        i = child;
+    }
+
+    heap[i] = cursor;
+}
+
+unsigned long _live_inline_nodes_(struct _dkedlist_ *list)
+{
+    struct _dkedlist_node_ *inline_nodes = INLINE_NODES(list);
+    unsigned long count = 0;
+
+    for (unsigned long i = 0; i < STATE(list)->inline_size; i++)
+    {
+        if (inline_nodes[i].list == list)
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+unsigned long _chunk_free_nodes_(struct _dkedlist_ *list)
+{
+    unsigned long count = STATE(list)->free_size;
+    struct _dkedlist_node_ *inline_nodes = INLINE_NODES(list);
+
+    for (unsigned long i = 0; i < STATE(list)->inline_size; i++)
+    {
+        if (inline_nodes[i].list != list)
+        {
+            count--;
+        }
+    }
+
+    return count;
+}
+
+void _adopt_storage_(struct _dkedlist_ *from, struct _dkedlist_ *to)
+{
+    if (STATE(from)->chunks)
+    {
+        struct _dkedlist_chunk_ *last = STATE(from)->chunks;
+
+        while (last->next)
+        {
+            last = last->next;
+        }
+
+        last->next = STATE(to)->chunks;
+        STATE(to)->chunks = STATE(from)->chunks;
+        STATE(from)->chunks = NULL;
+    }
+
+    struct _dkedlist_node_ *node = STATE(from)->free_nodes;
+
+    STATE(from)->free_nodes = NULL;
+    STATE(from)->free_size = 0;
+
+    // Free inline nodes can't leave the list allocation, so only chunk ones move
+    while (node)
+    {
+        struct _dkedlist_node_ *next = node->next;
+        struct _dkedlist_ *owner = _is_inline_(from, node) ? from : to;
+
+        node->next = STATE(owner)->free_nodes;
+        STATE(owner)->free_nodes = node;
+        STATE(owner)->free_size++;
+
+        node = next;
+    }
+}
+
+void _relocate_inline_nodes_(struct _dkedlist_ *list, struct _dkedlist_ *to)
+{
+    struct _dkedlist_node_ *inline_nodes = INLINE_NODES(list);
+
+    for (unsigned long i = 0; i < STATE(list)->inline_size; i++)
+    {
+        struct _dkedlist_node_ *node = &inline_nodes[i];
+
+        if (node->list != list)
+        {
+            continue;
+        }
+
+        // Enough free nodes were reserved in 'to' beforehand
+        struct _dkedlist_node_ *replacement = STATE(to)->free_nodes;
+
+        STATE(to)->free_nodes = replacement->next;
+        STATE(to)->free_size--;
+
+        replacement->prev = node->prev;
+        replacement->next = node->next;
+        replacement->list = list;
+        replacement->data = node->data;
+
+        if (node->prev)
+        {
+            node->prev->next = replacement;
+        }
+        else
+        {
+            list->head = replacement;
+        }
+
+        if (node->next)
+        {
+            node->next->prev = replacement;
+        }
+        else
+        {
+            list->tail = replacement;
+        }
+
+        _release_node_(list, node);
+    }
+}
+
+void _append_merged_(struct _dkedlist_node_ *node, struct _dkedlist_ *out)
+{
+    node->list = out;
+    node->prev = out->tail;
+
+    if (out->tail)
+    {
+        out->tail->next = node;
+    }
+    else
+    {
+        out->head = node;
+    }
+
+    out->tail = node;
+}
+
+void _merge_two_(int (*compare)(void *a, void *b), struct _dkedlist_node_ *a, struct _dkedlist_node_ *b, struct _dkedlist_ *out)
+{
+    while (a && b)
+    {
+        // Ties go to the first list to keep the merge stable
+        if (compare(b->data, a->data) < 0)
+        {
+            struct _dkedlist_node_ *next = b->next;
+
+            _append_merged_(b, out);
+            b = next;
+        }
+        else
+        {
+            struct _dkedlist_node_ *next = a->next;
+
+            _append_merged_(a, out);
+            a = next;
+        }
+    }
+
+    for (struct _dkedlist_node_ *rest = a ? a : b; rest;)
+    {
+        struct _dkedlist_node_ *next = rest->next;
+
+        _append_merged_(rest, out);
+        rest = next;
+    }
+}
+
+void _merge_k_(int (*compare)(void *a, void *b), struct _merge_cursor_ *heap, unsigned long size, struct _dkedlist_ *out)
+{
+    for (unsigned long i = size / 2; i > 0; i--)
+    {
+        _sift_down_(compare, heap, size, i - 1);
+    }
+
+    while (size > 0)
+    {
+        struct _dkedlist_node_ *node = heap[0].node;
+        struct _dkedlist_node_ *next = node->next;
+
+        _append_merged_(node, out);
+
+        if (next)
+        {
+            heap[0].node = next;
+        }
+        else
+        {
+            heap[0] = heap[--size];
+        }
+
+        if (size > 1)
+        {
+            _sift_down_(compare, heap, size, 0);
+        }
+    }
+}
+
+int _validate_iter_(struct _dkedlist_iter_ iterator)
+{
+    struct _dkedlist_ *list = iterator.list;
+
+    if (list->size == 0)
+    {
+        return 0;
+    }
+
+    if (iterator.initialized)
+    {
+        return 1;
+    }
+
+    if (iterator.forward && iterator.current_indx >= list->size - 1)
+    {
+        return 0;
+    }
+
+    if (!iterator.forward && iterator.current_indx == 0)
+    {
+        return 0;
+    }
+
+    return 1;
+}
+
+void *_dkedlist_allocate_(unsigned long size)
+{
+    return dkedlist_allocate(size);
+}
+
+void _dkedlist_deallocate_(unsigned long size, void *ptr)
+{
+    dkedlist_deallocte(size, ptr);
+}
+
+void dkedlist_set_malloc(void *(*dkedlist_malloc)(unsigned long size))
+{
+    if (dkedlist_malloc)
+    {
+        dkedlist_allocate = dkedlist_malloc;
+        return;
+    }
+
+    dkedlist_allocate = malloc;
+}
+
+void dkedlist_set_free(void (*dkedlist_free)(unsigned long size, void *ptr))
+{
+    if (dkedlist_free)
+    {
+        dkedlist_deallocte = dkedlist_free;
+        return;
+    }
+
+    dkedlist_deallocte = _custom_dealloc_;
+}
+
+void dkedlist_set_prefetch(char enabled)
+{
+#ifdef DKEDLIST_NO_PREFETCH
+    (void)enabled;
+#else
+    atomic_store_explicit(&prefetch_enabled, enabled ? 1 : 0, memory_order_relaxed);
+#endif
+}
+
+void dkedlist_iter_create(char forward, struct _dkedlist_iter_ *iterator, struct _dkedlist_ *list)
+{
+    if (forward)
+    {
+        iterator->current_indx = 0;
+    }
+    else
+    {
+        iterator->current_indx = list->size - 1;
+    }
+
+    iterator->initialized = 1;
+    iterator->current_node = NULL;
+    iterator->forward = forward;
+    iterator->list = list;
+}
+
+int dkedlist_iter_has_next(struct _dkedlist_iter_ iterator)
+{
+    return _validate_iter_(iterator);
+}
+
+struct _dkedlist_node_ *dkedlist_iter_next(struct _dkedlist_iter_ *iterator)
+{
+    struct _dkedlist_ *list = iterator->list;
+
+    int has_next = _validate_iter_(*iterator);
 
     if (!has_next)
     {
         return NULL;
     }
 
-    if (iterator->forward)
-    {
-        if (iterator->initialized)
-        {
-            iterator->initialized = 0;
-            iterator->current_node = list->head;
+    if (iterator->forward)
+    {
+        if (iterator->initialized)
+        {
+            iterator->initialized = 0;
+            iterator->current_node = list->head;
+
+            return iterator->current_node;
+        }
+
+        iterator->current_indx++;
+        iterator->current_node = iterator->current_node->next;
+
+        if (iterator->current_node->next && _prefetch_enabled_())
+        {
+            _dkedlist_prefetch_(iterator->current_node->next);
+        }
+    }
+    else
+    {
+        if (iterator->initialized)
+        {
+            iterator->initialized = 0;
+            iterator->current_node = list->tail;
+
+            return iterator->current_node;
+        }
+
+        iterator->current_indx--;
+        iterator->current_node = iterator->current_node->prev;
+
+        if (iterator->current_node->prev && _prefetch_enabled_())
+        {
+            _dkedlist_prefetch_(iterator->current_node->prev);
+        }
+    }
+
+    return iterator->current_node;
+}
+
+int dkedlist_create(void (*destroy_data)(void *data), struct _dkedlist_ **out_list)
+{
+    struct _dkedlist_ *list = NULL;
+
+    if (_create_list_(0, destroy_data, &list))
+    {
+        return DKEDLIST_ERR_ALLOC;
+    }
+
+    *out_list = list;
+
+    return DKEDLIST_OK;
+}
+
+int dkedlist_create_small(void (*destroy_data)(void *data), struct _dkedlist_ **out_list)
+{
+    struct _dkedlist_ *list = NULL;
+
+    if (_create_list_(DKEDLIST_INLINE_NODES, destroy_data, &list))
+    {
+        return DKEDLIST_ERR_ALLOC;
+    }
+
+    *out_list = list;
+
+    return DKEDLIST_OK;
+}
+
+int dkedlist_create_sorted(int (*compare)(void *a, void *b), void (*destroy_data)(void *data), struct _dkedlist_ **out_list)
+{
+    assert(compare && "compare can't be NULL");
+
+    struct _dkedlist_ *list = NULL;
+
+    if (_create_list_(0, destroy_data, &list))
+    {
+        return DKEDLIST_ERR_ALLOC;
+    }
+
+    if (_create_index_(compare, list))
+    {
+        dkedlist_destroy(&list);
+        return DKEDLIST_ERR_ALLOC;
+    }
+
+    *out_list = list;
+
+    return DKEDLIST_OK;
+}
+
+int dkedlist_insert_sorted(void *data, struct _dkedlist_ *list, struct _dkedlist_node_ **out_node)
+{
+    assert(STATE(list)->index && "list must be sorted");
+
+    struct _dkedlist_index_ *index = STATE(list)->index;
+    struct _dkedlist_lane_ *preds[DKEDLIST_MAX_LANES];
+    struct _dkedlist_lane_ *lane = NULL;
+    struct _dkedlist_node_ *node = NULL;
+
+    // Inserted after any node with the same key, keeping insertion order among them
+    struct _dkedlist_node_ *position = _search_(1, data, list, preds);
+    unsigned int height = _random_height_(index);
+
+    if (height)
+    {
+        lane = (struct _dkedlist_lane_ *)dkedlist_allocate(LANE_SIZE(height));
+
+        if (!lane)
+        {
+            return DKEDLIST_ERR_ALLOC;
+        }
+    }
+
+    if (_create_node_(data, list, &node))
+    {
+        if (lane)
+        {
+            dkedlist_deallocte(LANE_SIZE(height), lane);
+        }
+
+        return DKEDLIST_ERR_ALLOC;
+    }
+
+    if (position)
+    {
+        node->prev = position->prev;
+        node->next = position;
+
+        if (position->prev)
+        {
+            position->prev->next = node;
+        }
+        else
+        {
+            list->head = node;
+        }
+
+        position->prev = node;
+    }
+    else
+    {
+        node->prev = list->tail;
+
+        if (list->tail)
+        {
+            list->tail->next = node;
+        }
+        else
+        {
+            list->head = node;
+        }
+
+        list->tail = node;
+    }
+
+    list->size++;
+
+    if (lane)
+    {
+        lane->node = node;
+        lane->height = height;
+
+        // Lanes above the ones in use have no entries yet, so preds is NULL there
+        for (unsigned int level = 0; level < height; level++)
+        {
+            struct _dkedlist_lane_ **link = _lane_link_(index, preds[level], level);
+
+            lane->next[level] = *link;
+            *link = lane;
+        }
+
+        if (height > index->lanes)
+        {
+            index->lanes = height;
+        }
+    }
+
+    if (out_node)
+    {
+        *out_node = node;
+    }
+
+    return DKEDLIST_OK;
+}
+
+struct _dkedlist_node_ *dkedlist_lower_bound(void *key, struct _dkedlist_ *list)
+{
+    assert(STATE(list)->index && "list must be sorted");
+
+    return _search_(0, key, list, NULL);
+}
+
+struct _dkedlist_node_ *dkedlist_upper_bound(void *key, struct _dkedlist_ *list)
+{
+    assert(STATE(list)->index && "list must be sorted");
+
+    return _search_(1, key, list, NULL);
+}
 
-            return iterator->current_node;
-        }
+void dkedlist_for_each_range(void *from, void *to, void (*callback)(struct _dkedlist_node_ *node, void *context), void *context, struct _dkedlist_ *list)
+{
+    assert(STATE(list)->index && "list must be sorted");
 
-        iterator->current_indx++;
-        iterator->current_node = iterator->current_node->next;
-    }
-    else
+    int (*compare)(void *a, void *b) = STATE(list)->index->compare;
+    struct _dkedlist_node_ *current = _search_(0, from, list, NULL);
+
+    while (current && compare(current->data, to) < 0)
     {
-        if (iterator->initialized)
-        {
-            iterator->initialized = 0;
-            iterator->current_node = list->tail;
+        struct _dkedlist_node_ *next = current->next;
 
-            return iterator->current_node;
-        }
+        callback(current, context);
 
-        iterator->current_indx--;
-        iterator->current_node = iterator->current_node->prev;
+        current = next;
     }
-
-    return iterator->current_node;
 }
 
-int dkedlist_create(void (*destroy_data)(void *data), struct _dkedlist_ **out_list)
+void dkedlist_for_each(void (*callback)(struct _dkedlist_node_ *node, void *context), void *context, struct _dkedlist_ *list)
 {
-    struct _dkedlist_ *list = NULL;
+    struct _dkedlist_node_ *current = list->head;
 
-    if (_create_list_(destroy_data, &list))
+    while (current)
     {
-        return DKEDLIST_ERR_ALLOC;
-    }
+        struct _dkedlist_node_ *next = current->next;
 
-    list->size = 0;
-    list->head = NULL;
-    list->tail = NULL;
-    list->destroy_data = destroy_data;
+        _prefetch_next_(1, next);
 
-    *out_list = list;
+        callback(current, context);
 
-    return DKEDLIST_OK;
+        current = next;
+    }
 }
 
 struct _dkedlist_node_ *dkedlist_get_node(unsigned long index, struct _dkedlist_ *list)
@@ -309,7 +1466,7 @@ struct _dkedlist_node_ *dkedlist_get_node(unsigned long index, struct _dkedlist_
 
 void dkedlist_reverse(struct _dkedlist_ *list)
 {
-    if (list->size < 2)
+    if (STATE(list)->index || list->size < 2)
     {
         return;
     }
@@ -343,7 +1500,7 @@ int dkedlist_join(void (*destroy_data)(void *data), struct _dkedlist_ *a_list, s
     struct _dkedlist_iter_ iter;
     struct _dkedlist_ *list = NULL;
 
-    if (_create_list_(destroy_data, &list))
+    if (_create_list_(0, destroy_data, &list))
     {
         return DKEDLIST_ERR_ALLOC;
     }
@@ -401,7 +1558,7 @@ int dkedlist_sub_list(unsigned long from, unsigned long to, struct _dkedlist_ *l
     struct _dkedlist_iter_ iter;
     struct _dkedlist_ *new_list = NULL;
 
-    if (_create_list_(list->destroy_data, &new_list))
+    if (_create_list_(0, list->destroy_data, &new_list))
     {
         return DKEDLIST_ERR_ALLOC;
     }
@@ -434,8 +1591,123 @@ FINISH:
     return DKEDLIST_OK;
 }
 
+int dkedlist_reserve(unsigned long count, struct _dkedlist_ *list)
+{
+    return _reserve_nodes_(count, list);
+}
+
+void dkedlist_gather(struct _dkedlist_ *list, void **array)
+{
+    _gather_(list, array);
+}
+
+void dkedlist_gather_values(unsigned long value_size, struct _dkedlist_ *list, void *buffer)
+{
+    unsigned char *out = (unsigned char *)buffer;
+    struct _dkedlist_node_ *current = list->head;
+
+    while (current)
+    {
+        _prefetch_next_(1, current->next);
+
+        memcpy(out, current->data, value_size);
+
+        out += value_size;
+        current = current->next;
+    }
+}
+
+int dkedlist_to_array(struct _dkedlist_ *list, void ***out_array)
+{
+    if (list->size == 0)
+    {
+        *out_array = NULL;
+        return DKEDLIST_OK;
+    }
+
+    void **array = (void **)dkedlist_allocate(list->size * sizeof(void *));
+
+    if (!array)
+    {
+        return DKEDLIST_ERR_ALLOC;
+    }
+
+    _gather_(list, array);
+
+    *out_array = array;
+
+    return DKEDLIST_OK;
+}
+
+void dkedlist_destroy_array(unsigned long size, void ***array)
+{
+    if (!array || !(*array))
+    {
+        return;
+    }
+
+    dkedlist_deallocte(size * sizeof(void *), *array);
+
+    *array = NULL;
+}
+
+int dkedlist_from_array(void (*destroy_data)(void *data), void **array, unsigned long count, struct _dkedlist_ **out_list)
+{
+    struct _dkedlist_ *list = NULL;
+
+    if (_create_list_(0, destroy_data, &list))
+    {
+        return DKEDLIST_ERR_ALLOC;
+    }
+
+    if (_reserve_nodes_(count, list))
+    {
+        dkedlist_destroy(&list);
+        return DKEDLIST_ERR_ALLOC;
+    }
+
+    _append_reserved_(array, count, list);
+
+    *out_list = list;
+
+    return DKEDLIST_OK;
+}
+
+int dkedlist_assign_from_array(void **array, unsigned long count, struct _dkedlist_ *list)
+{
+    _remove_all_nodes_(0, list);
+
+    if (_reserve_nodes_(count, list))
+    {
+        return DKEDLIST_ERR_ALLOC;
+    }
+
+    if (STATE(list)->index)
+    {
+        for (unsigned long i = 0; i < count; i++)
+        {
+            if (dkedlist_insert_sorted(array[i], list, NULL))
+            {
+                _remove_all_nodes_(0, list);
+                return DKEDLIST_ERR_ALLOC;
+            }
+        }
+
+        return DKEDLIST_OK;
+    }
+
+    _append_reserved_(array, count, list);
+
+    return DKEDLIST_OK;
+}
+
 int dkedlist_insert(void *data, struct _dkedlist_ *list, struct _dkedlist_node_ **out_node)
 {
+    if (STATE(list)->index)
+    {
+        return dkedlist_insert_sorted(data, list, out_node);
+    }
+
     struct _dkedlist_node_ *node = NULL;
 
     if (_create_node_(data, list, &node))
@@ -467,6 +1739,12 @@ int dkedlist_insert(void *data, struct _dkedlist_ *list, struct _dkedlist_node_
 int dkedlist_insert_next(void *data, struct _dkedlist_node_ *node, struct _dkedlist_node_ **out_node)
 {
     struct _dkedlist_ *list = node->list;
+
+    if (STATE(list)->index)
+    {
+        return DKEDLIST_ILLEGAL_SORTED;
+    }
+
     struct _dkedlist_node_ *new_node = NULL;
 
     if (_create_node_(data, list, &new_node))
@@ -501,6 +1779,12 @@ int dkedlist_insert_next(void *data, struct _dkedlist_node_ *node, struct _dkedl
 int dkedlist_insert_prev(void *data, struct _dkedlist_node_ *node, struct _dkedlist_node_ **out_node)
 {
     struct _dkedlist_ *list = node->list;
+
+    if (STATE(list)->index)
+    {
+        return DKEDLIST_ILLEGAL_SORTED;
+    }
+
     struct _dkedlist_node_ *new_node = NULL;
 
     if (_create_node_(data, list, &new_node))
@@ -558,7 +1842,7 @@ void dkedlist_remove_all(struct _dkedlist_ *list)
 
 void dkedlist_remove_all_clean(struct _dkedlist_ *list)
 {
-    _remove_all_nodes_(0, list);
+    _remove_all_nodes_(1, list);
 }
 
 void dkedlist_destroy(struct _dkedlist_ **list)
@@ -569,4 +1853,231 @@ void dkedlist_destroy(struct _dkedlist_ **list)
 void dkedlist_destroy_clean(struct _dkedlist_ **list)
 {
     _destroy_list_(1, list);
-}
\ No newline at end of file
+}
+
+int dkedlist_destroy_deferred(struct _dkedlist_ **list)
+{
+    return _defer_list_(0, list);
+}
+
+int dkedlist_destroy_deferred_clean(struct _dkedlist_ **list)
+{
+    return _defer_list_(1, list);
+}
+
+unsigned long dkedlist_reclaim_step(unsigned long budget)
+{
+    return _reclaim_step_(budget);
+}
+
+unsigned long dkedlist_reclaim_pending(void)
+{
+    pthread_mutex_lock(&reclaim_lock);
+
+    unsigned long pending = reclaim_pending;
+
+    pthread_mutex_unlock(&reclaim_lock);
+
+    return pending;
+}
+
+void dkedlist_reclaim_drain(void)
+{
+    pthread_mutex_lock(&reclaim_lock);
+
+    while (reclaim_queue || reclaim_in_flight)
+    {
+        if (!reclaim_queue)
+        {
+            pthread_cond_wait(&reclaim_cond, &reclaim_lock);
+            continue;
+        }
+
+        pthread_mutex_unlock(&reclaim_lock);
+
+        _reclaim_step_((unsigned long)-1);
+
+        pthread_mutex_lock(&reclaim_lock);
+    }
+
+    pthread_mutex_unlock(&reclaim_lock);
+}
+
+void dkedlist_set_reclaim_limit(unsigned long limit)
+{
+    pthread_mutex_lock(&reclaim_lock);
+
+    reclaim_limit = limit;
+
+    pthread_mutex_unlock(&reclaim_lock);
+}
+
+int dkedlist_reclaimer_start(unsigned long budget)
+{
+    pthread_mutex_lock(&reclaim_lock);
+
+    // A thread being stopped still reads reclaimer_running, so it must be gone first
+    while (reclaimer_stopping)
+    {
+        pthread_cond_wait(&reclaim_cond, &reclaim_lock);
+    }
+
+    if (reclaimer_running)
+    {
+        reclaimer_budget = budget;
+        pthread_mutex_unlock(&reclaim_lock);
+
+        return DKEDLIST_OK;
+    }
+
+    reclaimer_running = 1;
+    reclaimer_budget = budget;
+
+    if (pthread_create(&reclaimer, NULL, _reclaimer_loop_, NULL))
+    {
+        reclaimer_running = 0;
+        pthread_mutex_unlock(&reclaim_lock);
+
+        return DKEDLIST_ERR_THREAD;
+    }
+
+    pthread_mutex_unlock(&reclaim_lock);
+
+    return DKEDLIST_OK;
+}
+
+void dkedlist_reclaimer_stop(char drain)
+{
+    pthread_mutex_lock(&reclaim_lock);
+
+    while (reclaimer_stopping)
+    {
+        pthread_cond_wait(&reclaim_cond, &reclaim_lock);
+    }
+
+    char running = reclaimer_running;
+    pthread_t thread = reclaimer;
+
+    reclaimer_running = 0;
+    reclaimer_stopping = running;
+
+    pthread_cond_broadcast(&reclaim_cond);
+    pthread_mutex_unlock(&reclaim_lock);
+
+    if (running)
+    {
+        pthread_join(thread, NULL);
+
+        pthread_mutex_lock(&reclaim_lock);
+
+        reclaimer_stopping = 0;
+
+        pthread_cond_broadcast(&reclaim_cond);
+        pthread_mutex_unlock(&reclaim_lock);
+    }
+
+    if (drain)
+    {
+        dkedlist_reclaim_drain();
+    }
+}
+
+int dkedlist_merge(struct _dkedlist_ **lists, unsigned long k, int (*compare)(void *a, void *b), struct _dkedlist_ *out)
+{
+    assert(compare && "compare can't be NULL");
+
+    if (STATE(out)->index)
+    {
+        return DKEDLIST_ILLEGAL_SORTED;
+    }
+
+    struct _merge_cursor_ stack_heap[DKEDLIST_MERGE_STACK];
+    struct _merge_cursor_ *heap = stack_heap;
+    unsigned long live_inline = 0;
+    unsigned long movable = STATE(out)->free_size;
+
+    for (unsigned long i = 0; i < k; i++)
+    {
+        assert(lists[i] != out && "out can't be one of the input lists");
+
+        live_inline += _live_inline_nodes_(lists[i]);
+        movable += _chunk_free_nodes_(lists[i]);
+    }
+
+    // Everything that can fail happens before touching any list
+    if (k > DKEDLIST_MERGE_STACK)
+    {
+        heap = (struct _merge_cursor_ *)dkedlist_allocate(k * sizeof(struct _merge_cursor_));
+
+        if (!heap)
+        {
+            return DKEDLIST_ERR_ALLOC;
+        }
+    }
+
+    if (live_inline > movable && _reserve_nodes_(STATE(out)->free_size + live_inline - movable, out))
+    {
+        if (heap != stack_heap)
+        {
+            dkedlist_deallocte(k * sizeof(struct _merge_cursor_), heap);
+        }
+
+        return DKEDLIST_ERR_ALLOC;
+    }
+
+    unsigned long size = 0;
+    unsigned long total = 0;
+
+    for (unsigned long i = 0; i < k; i++)
+    {
+        _adopt_storage_(lists[i], out);
+    }
+
+    for (unsigned long i = 0; i < k; i++)
+    {
+        struct _dkedlist_ *list = lists[i];
+
+        if (STATE(list)->index)
+        {
+            _clear_lanes_(list);
+        }
+
+        _relocate_inline_nodes_(list, out);
+
+        if (list->head)
+        {
+            heap[size].node = list->head;
+            heap[size].source = i;
+            size++;
+        }
+
+        total += list->size;
+
+        list->head = NULL;
+        list->tail = NULL;
+        list->size = 0;
+    }
+
+    if (size == 2)
+    {
+        _merge_two_(compare, heap[0].node, heap[1].node, out);
+    }
+    else
+    {
+        _merge_k_(compare, heap, size, out);
+    }
+
+    if (out->tail)
+    {
+        out->tail->next = NULL;
+    }
+
+    out->size += total;
+
+    if (heap != stack_heap)
+    {
+        dkedlist_deallocte(k * sizeof(struct _merge_cursor_), heap);
+    }
+
+    return DKEDLIST_OK;
+}
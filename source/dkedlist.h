@@ -52,6 +52,17 @@ void dkedlist_set_malloc(void *(*dkedlist_malloc)(unsigned long size));
 
 void dkedlist_set_free(void(*dkedlist_free)(unsigned long size, void *ptr));
 
+/**
+ * @brief Enables or disables prefetching in the traversal functions (dkedlist_iter_next,
+ * dkedlist_for_each, dkedlist_remove_all, dkedlist_destroy and their clean variants).
+ * While walking, they prefetch the node after the next one and the next node's data.
+ * Disabled by default, as it showed no gain over the plain walk in dkedlist_bench.
+ * Can be called from any thread. Does nothing when built with DKEDLIST_NO_PREFETCH.
+ *
+ * @param enabled 0 to use the plain walk, any other value to prefetch.
+ */
+void dkedlist_set_prefetch(char enabled);
+
 /**
  * @brief Initialize a _dkedlist_iter_ structure with the information
  * related to iterate the specified list.
@@ -80,7 +91,9 @@ int dkedlist_iter_has_next(struct _dkedlist_iter_ iterator);
 struct _dkedlist_node_ *dkedlist_iter_next(struct _dkedlist_iter_ *iterator);
 
 /**
- * @brief Creates a new list.
+ * @brief Creates a new list. Nodes are allocated in chunks, each one as large
+ * as the list when it runs out of nodes. Removed nodes are kept for reuse and
+ * released with the list.
  *
  * @param destroy_data Pointer to a function used to help deallocate
  * memory allocated data inserted in the list (if any). Can be NULL.
@@ -90,6 +103,92 @@ struct _dkedlist_node_ *dkedlist_iter_next(struct _dkedlist_iter_ *iterator);
  */
 int dkedlist_create(void (*destroy_data)(void *data), struct _dkedlist_ **out_list);
 
+/**
+ * @brief Creates a new list meant to hold a few elements. The list is allocated
+ * together with room for its first DKEDLIST_INLINE_NODES nodes (3 unless changed
+ * at build time), placed right after it, so small lists don't need any other
+ * allocation and walking them only reads those 128 contiguous bytes. Nodes beyond
+ * those are allocated as usual.
+ *
+ * @param destroy_data Pointer to a function used to help deallocate
+ * memory allocated data inserted in the list (if any). Can be NULL.
+ * @param out_list Pointer to a pointer where the created list will
+ * be passed. Must not be NULL.
+ * @return DKEDLIST_ERR_ALLOC if allocation error happens. DKEDLIST_OK otherwise.
+ */
+int dkedlist_create_small(void (*destroy_data)(void *data), struct _dkedlist_ **out_list);
+
+/**
+ * @brief Creates a new sorted list. Nodes are kept ordered by the specified
+ * function, with skip list lanes on top of the nodes to find positions in
+ * O(log n) expected time. dkedlist_insert inserts in order on these lists;
+ * dkedlist_insert_next and dkedlist_insert_prev fail with DKEDLIST_ILLEGAL_SORTED
+ * and dkedlist_reverse does nothing on them. Iteration and removal work as in any other list.
+ *
+ * @param compare Pointer to a function returning a negative value if a goes before b,
+ * a positive value if a goes after b and 0 if they are equivalent. Must not be NULL.
+ * @param destroy_data Pointer to a function used to help deallocate
+ * memory allocated data inserted in the list (if any). Can be NULL.
+ * @param out_list Pointer to a pointer where the created list will
+ * be passed. Must not be NULL.
+ * @return DKEDLIST_ERR_ALLOC if allocation error happens. DKEDLIST_OK otherwise.
+ */
+int dkedlist_create_sorted(int (*compare)(void *a, void *b), void (*destroy_data)(void *data), struct _dkedlist_ **out_list);
+
+/**
+ * @brief Inserts a data into a sorted list, after any node equivalent to it.
+ *
+ * @param data Pointer to data to be inserted. Can be NULL if compare accepts it.
+ * @param list Pointer to a list created with dkedlist_create_sorted. Must not be NULL.
+ * @param out_node Pointer to a pointer in which the created node of the inserted
+ * data will be saved. Can be NULL.
+ * @return DKEDLIST_ERR_ALLOC if allocation error happens. DKEDLIST_OK otherwise.
+ */
+int dkedlist_insert_sorted(void *data, struct _dkedlist_ *list, struct _dkedlist_node_ **out_node);
+
+/**
+ * @brief Gets the first node of a sorted list which doesn't go before the key.
+ *
+ * @param key Pointer passed to compare as any other data.
+ * @param list Pointer to a list created with dkedlist_create_sorted. Must not be NULL.
+ * @return NULL if every node goes before the key. struct _dkedlist_node_* otherwise.
+ */
+struct _dkedlist_node_ *dkedlist_lower_bound(void *key, struct _dkedlist_ *list);
+
+/**
+ * @brief Gets the first node of a sorted list which goes after the key.
+ *
+ * @param key Pointer passed to compare as any other data.
+ * @param list Pointer to a list created with dkedlist_create_sorted. Must not be NULL.
+ * @return NULL if no node goes after the key. struct _dkedlist_node_* otherwise.
+ */
+struct _dkedlist_node_ *dkedlist_upper_bound(void *key, struct _dkedlist_ *list);
+
+/**
+ * @brief Calls the specified function for every node of a sorted list
+ * from the key 'from' (inclusive) to the key 'to' (exclusive), in order.
+ *
+ * @param from Pointer to the key where the range starts.
+ * @param to Pointer to the key where the range ends.
+ * @param callback Function called for each node. It can remove the node it receives,
+ * but must not remove or insert any other node. Must not be NULL.
+ * @param context Pointer passed as is to every callback call. Can be NULL.
+ * @param list Pointer to a list created with dkedlist_create_sorted. Must not be NULL.
+ */
+void dkedlist_for_each_range(void *from, void *to, void (*callback)(struct _dkedlist_node_ *node, void *context), void *context, struct _dkedlist_ *list);
+
+/**
+ * @brief Calls the specified function for every node in the list, from head to tail.
+ * When enabled with dkedlist_set_prefetch, the node after the next one, as well
+ * as the next node's data, are prefetched.
+ *
+ * @param callback Function called for each node. It can remove the node it receives,
+ * but must not remove or insert any other node. Must not be NULL.
+ * @param context Pointer passed as is to every callback call. Can be NULL.
+ * @param list Pointer to the list. Must not be NULL.
+ */
+void dkedlist_for_each(void (*callback)(struct _dkedlist_node_ *node, void *context), void *context, struct _dkedlist_ *list);
+
 /**
  * @brief Gets a specific node based in the submitted index
  *
@@ -101,7 +200,7 @@ int dkedlist_create(void (*destroy_data)(void *data), struct _dkedlist_ **out_li
 struct _dkedlist_node_ *dkedlist_get_node(unsigned long index, struct _dkedlist_ *list);
 
 /**
- * @brief Reverses the list.
+ * @brief Reverses the list. Sorted lists are left untouched.
  *
  * @param list Pointer to the list structure. Must not be NULL.
  */
@@ -126,6 +225,32 @@ void dkedlist_reverse(struct _dkedlist_ *list);
  */
 int dkedlist_join(void (*destroy_data)(void *data), struct _dkedlist_ *a_list, struct _dkedlist_ *b_list, struct _dkedlist_ **out_list);
 
+/**
+ * @brief Merges several sorted lists into one, moving their nodes instead of
+ * copying them. Nodes considered equivalent keep the order of the input lists.
+ * The merged nodes are appended after the ones already in 'out', and the
+ * input lists are left empty, along with their unused nodes which now belong
+ * to 'out'.
+ *
+ * Inputs created with dkedlist_create, dkedlist_create_sorted or any function
+ * other than dkedlist_create_small are merged without allocating a single node,
+ * and handles to their nodes stay valid. Inputs created with
+ * dkedlist_create_small may keep nodes inside their own list allocation; the
+ * data of those nodes is moved into unused nodes of 'out', created if there
+ * aren't enough, and the old handles to them are no longer valid.
+ *
+ * @param lists Pointer to the array of lists to merge. Each one must be ordered
+ * according to compare. Must not be NULL unless k is 0.
+ * @param k The numbers of lists in the array.
+ * @param compare Pointer to a function returning a negative value if a goes before b,
+ * a positive value if a goes after b and 0 if they are equivalent. Must not be NULL.
+ * @param out Pointer to the list receiving the nodes. Must not be one of the
+ * inputs. Must not be NULL.
+ * @return DKEDLIST_ILLEGAL_SORTED if 'out' is a sorted list. DKEDLIST_ERR_ALLOC if
+ * allocation error happens. In both cases no list is modified. DKEDLIST_OK otherwise.
+ */
+int dkedlist_merge(struct _dkedlist_ **lists, unsigned long k, int (*compare)(void *a, void *b), struct _dkedlist_ *out);
+
 /**
  * @brief Creates new list from the given range (inclusive)
  *
@@ -139,6 +264,86 @@ int dkedlist_join(void (*destroy_data)(void *data), struct _dkedlist_ *a_list, s
  */
 int dkedlist_sub_list(unsigned long from, unsigned long to, struct _dkedlist_ *list, struct _dkedlist_ **out_list);
 
+/**
+ * @brief Makes sure the list owns at least 'count' unused nodes, creating
+ * the missing ones in a single allocation. Following insertions take their
+ * nodes from there until they are exhausted, so they can't fail.
+ *
+ * @param count The numbers of unused nodes required.
+ * @param list Pointer to the list. Must not be NULL.
+ * @return DKEDLIST_ERR_ALLOC if allocation error happens. DKEDLIST_OK otherwise.
+ */
+int dkedlist_reserve(unsigned long count, struct _dkedlist_ *list);
+
+/**
+ * @brief Copies the data pointers of every node, from head to tail,
+ * into the specified array.
+ *
+ * @param list Pointer to the list. Must not be NULL.
+ * @param array Pointer to an array with room for at least list->size
+ * elements. Can be NULL only if the list is empty.
+ */
+void dkedlist_gather(struct _dkedlist_ *list, void **array);
+
+/**
+ * @brief Copies the values pointed by the data of every node, from head
+ * to tail, one after another into the specified buffer.
+ *
+ * @param value_size Size in bytes of every value. Every node's data must
+ * point to at least this many bytes.
+ * @param list Pointer to the list. Must not be NULL.
+ * @param buffer Pointer to a buffer with room for at least
+ * value_size * list->size bytes. Can be NULL only if the list is empty.
+ */
+void dkedlist_gather_values(unsigned long value_size, struct _dkedlist_ *list, void *buffer);
+
+/**
+ * @brief Creates a new array containing the data pointers of every node,
+ * from head to tail. The array must be released with dkedlist_destroy_array.
+ *
+ * @param list Pointer to the list. Must not be NULL.
+ * @param out_array Pointer to a pointer where the created array will be
+ * passed. Set to NULL if the list is empty. Must not be NULL.
+ * @return DKEDLIST_ERR_ALLOC if allocation error happens. DKEDLIST_OK otherwise.
+ */
+int dkedlist_to_array(struct _dkedlist_ *list, void ***out_array);
+
+/**
+ * @brief Destroys an array created by dkedlist_to_array.
+ *
+ * @param size The numbers of elements in the array.
+ * @param array Pointer to the array. Must not be NULL.
+ */
+void dkedlist_destroy_array(unsigned long size, void ***array);
+
+/**
+ * @brief Creates a new list containing the specified data, in the same order.
+ * All nodes are created in a single allocation.
+ *
+ * @param destroy_data Pointer to a function used to help deallocate
+ * memory allocated data inserted in the list (if any). Can be NULL.
+ * @param array Pointer to the data to insert. Can be NULL only if count is 0.
+ * @param count The numbers of elements in the array.
+ * @param out_list Pointer to a pointer where the created list will
+ * be passed. Must not be NULL.
+ * @return DKEDLIST_ERR_ALLOC if allocation error happens. DKEDLIST_OK otherwise.
+ */
+int dkedlist_from_array(void (*destroy_data)(void *data), void **array, unsigned long count, struct _dkedlist_ **out_list);
+
+/**
+ * @brief Replaces the content of the list with the specified data, in the same
+ * order. The current nodes are removed without calling destroy_data; nodes
+ * already owned by the list are reused and the missing ones are created in a
+ * single allocation.
+ *
+ * @param array Pointer to the data to insert. Can be NULL only if count is 0.
+ * @param count The numbers of elements in the array.
+ * @param list Pointer to the list. Must not be NULL.
+ * @return DKEDLIST_ERR_ALLOC if allocation error happens, in which case the list
+ * is left empty. DKEDLIST_OK otherwise.
+ */
+int dkedlist_assign_from_array(void **array, unsigned long count, struct _dkedlist_ *list);
+
 /**
  * @brief Insert a data into the list.
  *
@@ -157,7 +362,8 @@ int dkedlist_insert(void *data, struct _dkedlist_ *list, struct _dkedlist_node_
  * @param node Pointer to the node in wich the new one will be next inserted. Must not be NULL.
  * @param out_node Pointer to a pointer in which the created node of the inserted
  * data will be saved. Can be NULL.
- * @return DKEDLIST_ERR_ALLOC if allocation error happens. DKEDLIST_OK otherwise.
+ * @return DKEDLIST_ILLEGAL_SORTED if the node belongs to a sorted list. DKEDLIST_ERR_ALLOC
+ * if allocation error happens. DKEDLIST_OK otherwise.
  */
 int dkedlist_insert_next(void *data, struct _dkedlist_node_ *node, struct _dkedlist_node_ **out_node);
 
@@ -168,7 +374,8 @@ int dkedlist_insert_next(void *data, struct _dkedlist_node_ *node, struct _dkedl
  * @param node Pointer to the node in wich the new one will be previous inserted. Must not be NULL.
  * @param out_node Pointer to a pointer in which the created node of the inserted
  * data will be saved. Can be NULL.
- * @return DKEDLIST_ERR_ALLOC if allocation error happens. DKEDLIST_OK otherwise.
+ * @return DKEDLIST_ILLEGAL_SORTED if the node belongs to a sorted list. DKEDLIST_ERR_ALLOC
+ * if allocation error happens. DKEDLIST_OK otherwise.
  */
 int dkedlist_insert_prev(void *data, struct _dkedlist_node_ *node, struct _dkedlist_node_ **out_node);
 
@@ -222,6 +429,81 @@ void dkedlist_destroy(struct _dkedlist_ **list);
  */
 void dkedlist_destroy_clean(struct _dkedlist_ **list);
 
+/**
+ * @brief Detaches the list in constant time and queues it to be destroyed
+ * later, either by the background reclaimer (see dkedlist_reclaimer_start)
+ * or by calls to dkedlist_reclaim_step. Nodes are deallocated from the thread
+ * doing the reclamation, so the configured free function must be thread safe.
+ *
+ * @param list Pointer to the list. Set to NULL once queued. Must not be NULL.
+ * @return DKEDLIST_ERR_BUSY if the pending nodes already reached the limit set
+ * with dkedlist_set_reclaim_limit, in which case the list is left untouched.
+ * DKEDLIST_OK otherwise.
+ */
+int dkedlist_destroy_deferred(struct _dkedlist_ **list);
+
+/**
+ * @brief Same as dkedlist_destroy_deferred, but the internal destroy_data function
+ * is called for every node when it's reclaimed. destroy_data is called from the
+ * thread doing the reclamation.
+ *
+ * @param list Pointer to the list. Set to NULL once queued. Must not be NULL.
+ * @return DKEDLIST_ERR_BUSY if the pending nodes already reached the limit set
+ * with dkedlist_set_reclaim_limit, in which case the list is left untouched.
+ * DKEDLIST_OK otherwise.
+ */
+int dkedlist_destroy_deferred_clean(struct _dkedlist_ **list);
+
+/**
+ * @brief Does at most 'budget' units of work on the lists queued for destruction.
+ * A unit is a call to destroy_data, or the release of a lane entry or of a chunk
+ * of nodes, so the time a step takes doesn't depend on the size of the lists.
+ * Meant to be called periodically, for example from an event loop.
+ *
+ * @param budget The maximum numbers of units of work to do.
+ * @return 0 if nothing is left to reclaim. Non zero otherwise.
+ */
+unsigned long dkedlist_reclaim_step(unsigned long budget);
+
+/**
+ * @brief Gets the numbers of nodes queued for destruction and not yet reclaimed.
+ *
+ */
+unsigned long dkedlist_reclaim_pending(void);
+
+/**
+ * @brief Reclaims every list queued for destruction before returning, waiting
+ * for lists being reclaimed by other threads, such as the background reclaimer.
+ *
+ */
+void dkedlist_reclaim_drain(void);
+
+/**
+ * @brief Sets the maximum numbers of pending nodes accepted by dkedlist_destroy_deferred.
+ * Once reached, it returns DKEDLIST_ERR_BUSY until the reclamation catches up.
+ *
+ * @param limit The maximum numbers of pending nodes. 0 means no limit, which is the default.
+ */
+void dkedlist_set_reclaim_limit(unsigned long limit);
+
+/**
+ * @brief Starts a background thread reclaiming the lists queued for destruction.
+ * If it's already running, only its budget is updated. If it's being stopped,
+ * waits for it to finish first.
+ *
+ * @param budget The units of work (see dkedlist_reclaim_step) done between checks of the queue. 0 means no limit.
+ * @return DKEDLIST_ERR_THREAD if the thread can't be created. DKEDLIST_OK otherwise.
+ */
+int dkedlist_reclaimer_start(unsigned long budget);
+
+/**
+ * @brief Stops the background reclaimer (if running) and waits for it to finish.
+ * Can be called concurrently with dkedlist_reclaimer_start and itself.
+ *
+ * @param drain If not 0, every list still queued is reclaimed before returning.
+ */
+void dkedlist_reclaimer_stop(char drain);
+
 /**
  * @brief Gets the first node from the list (if any).
  * Returns NULL in case of list size equals to 0.
@@ -0,0 +1,154 @@
+#include "dkedlist.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/*
+ * Compares the plain walk with the prefetching walk of dkedlist_for_each
+ * and dkedlist_destroy_clean. Nodes are linked in a
+ * random order and their data is scattered, so the list behaves like
+ * one built by unrelated insertions once it no longer fits in cache.
+ *
+ * Usage: dkedlist_bench [nodes]
+ */
+
+static long sum = 0;
+
+static void add_data(struct _dkedlist_node_ *node, void *context)
+{
+    (void)context;
+    sum += *(long *)node->data;
+}
+
+static void touch_data(void *data)
+{
+    sum += *(long *)data;
+}
+
+static unsigned long next_random(unsigned long *state)
+{
+    *state = *state * 6364136223846793005UL + 1442695040888963407UL;
+    return *state >> 17;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void shuffle(unsigned long count, void **items, unsigned long *state)
+{
+    for (unsigned long i = count - 1; i > 0; i--)
+    {
+        unsigned long j = next_random(state) % (i + 1);
+        void *tmp = items[i];
+
+        items[i] = items[j];
+        items[j] = tmp;
+    }
+}
+
+static struct _dkedlist_ *build_list(unsigned long count, long *values, unsigned long *state)
+{
+    struct _dkedlist_ *list = NULL;
+    void **nodes = malloc(count * sizeof(void *));
+
+    if (!nodes || dkedlist_create(touch_data, &list))
+    {
+        fprintf(stderr, "allocation failed\n");
+        exit(1);
+    }
+
+    for (unsigned long i = 0; i < count; i++)
+    {
+        if (dkedlist_insert(&values[next_random(state) % count], list, (struct _dkedlist_node_ **)&nodes[i]))
+        {
+            fprintf(stderr, "allocation failed\n");
+            exit(1);
+        }
+    }
+
+    // Relink the nodes in random order
+    shuffle(count, nodes, state);
+
+    for (unsigned long i = 0; i < count; i++)
+    {
+        struct _dkedlist_node_ *node = nodes[i];
+
+        node->prev = i > 0 ? nodes[i - 1] : NULL;
+        node->next = i + 1 < count ? nodes[i + 1] : NULL;
+    }
+
+    list->head = nodes[0];
+    list->tail = nodes[count - 1];
+
+    free(nodes);
+
+    return list;
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long count = argc > 1 ? strtoul(argv[1], NULL, 10) : 16UL * 1024 * 1024;
+    unsigned long state = 88172645463325252UL;
+    long *values = malloc(count * sizeof(long));
+    const char *modes[] = {"plain", "prefetch"};
+
+    if (count < 2 || !values)
+    {
+        fprintf(stderr, "usage: dkedlist_bench [nodes >= 2]\n");
+        return 1;
+    }
+
+    for (unsigned long i = 0; i < count; i++)
+    {
+        values[i] = (long)i;
+    }
+
+    struct _dkedlist_ *list = build_list(count, values, &state);
+
+    printf("%lu nodes\n", count);
+
+    // Modes alternate so neither one benefits from running later
+    for (int round = 0; round < 3; round++)
+    {
+        for (int enabled = 0; enabled < 2; enabled++)
+        {
+            dkedlist_set_prefetch((char)enabled);
+
+            double start = now();
+
+            dkedlist_for_each(add_data, NULL, list);
+
+            printf("for_each      %-8s: %6.2f ns/node\n", modes[enabled], (now() - start) * 1e9 / count);
+        }
+    }
+
+    dkedlist_destroy(&list);
+
+    for (int round = 0; round < 2; round++)
+    {
+        for (int enabled = 0; enabled < 2; enabled++)
+        {
+            list = build_list(count, values, &state);
+
+            dkedlist_set_prefetch((char)enabled);
+
+            double start = now();
+
+            dkedlist_destroy_clean(&list);
+
+            printf("destroy_clean %-8s: %6.2f ns/node\n", modes[enabled], (now() - start) * 1e9 / count);
+        }
+    }
+
+    printf("checksum %ld\n", sum);
+
+    free(values);
+
+    return 0;
+}
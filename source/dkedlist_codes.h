@@ -4,5 +4,11 @@
 #define DKEDLIST_OK 0
 #define DKEDLIST_ERR_ALLOC 1
 #define DKEDLIST_ILLEGAL_INDEX 2
+#define DKEDLIST_ERR_IO 3
+#define DKEDLIST_ERR_FORMAT 4
+#define DKEDLIST_ERR_DECODE 5
+#define DKEDLIST_ERR_BUSY 6
+#define DKEDLIST_ERR_THREAD 7
+#define DKEDLIST_ILLEGAL_SORTED 8
 
 #endif
\ No newline at end of file
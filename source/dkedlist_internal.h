@@ -0,0 +1,18 @@
+#ifndef _DKEDLIST_INTERNAL_H_
+#define _DKEDLIST_INTERNAL_H_
+
+/**
+ * @brief Allocates memory with the function set by dkedlist_set_malloc.
+ * Meant for the library modules, not for users.
+ *
+ */
+void *_dkedlist_allocate_(unsigned long size);
+
+/**
+ * @brief Releases memory with the function set by dkedlist_set_free.
+ * Meant for the library modules, not for users.
+ *
+ */
+void _dkedlist_deallocate_(unsigned long size, void *ptr);
+
+#endif
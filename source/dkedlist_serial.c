@@ -0,0 +1,532 @@
+#include "dkedlist_serial.h"
+#include "dkedlist_codes.h"
+#include "dkedlist_internal.h"
+#include <stdint.h>
+#include <limits.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <assert.h>
+
+#define HEADER_SIZE 16
+#define CHUNK_HEADER_SIZE 8
+#define RECORD_HEADER_SIZE 8
+#define ALIGNMENT 8
+#define PADDED(size) (((size) + ALIGNMENT - 1) & ~(unsigned long)(ALIGNMENT - 1))
+
+static const unsigned char magic[4] = {'D', 'K', 'D', 'L'};
+
+struct _serial_writer_
+{
+    int fd;
+    unsigned char *buffer;  // Chunk being built, including its header.
+    unsigned long used;     // Bytes used in buffer.
+    uint32_t records;       // Records in the chunk being built.
+};
+
+void _put_u32_(uint32_t value, unsigned char *out)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        out[i] = (unsigned char)(value >> (i * 8));
+    }
+}
+
+void _put_u64_(uint64_t value, unsigned char *out)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        out[i] = (unsigned char)(value >> (i * 8));
+    }
+}
+
+uint32_t _get_u32_(const unsigned char *in)
+{
+    uint32_t value = 0;
+
+    for (int i = 3; i >= 0; i--)
+    {
+        value = (value << 8) | in[i];
+    }
+
+    return value;
+}
+
+uint64_t _get_u64_(const unsigned char *in)
+{
+    uint64_t value = 0;
+
+    for (int i = 7; i >= 0; i--)
+    {
+        value = (value << 8) | in[i];
+    }
+
+    return value;
+}
+
+int _write_all_(int fd, const unsigned char *bytes, unsigned long size)
+{
+    while (size > 0)
+    {
+        ssize_t written = write(fd, bytes, size);
+
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            return DKEDLIST_ERR_IO;
+        }
+
+        bytes += written;
+        size -= (unsigned long)written;
+    }
+
+    return DKEDLIST_OK;
+}
+
+int _read_all_(int fd, unsigned char *bytes, unsigned long size)
+{
+    while (size > 0)
+    {
+        ssize_t count = read(fd, bytes, size);
+
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            return DKEDLIST_ERR_IO;
+        }
+
+        if (count == 0)
+        {
+            return DKEDLIST_ERR_FORMAT;
+        }
+
+        bytes += count;
+        size -= (unsigned long)count;
+    }
+
+    return DKEDLIST_OK;
+}
+
+int _flush_chunk_(struct _serial_writer_ *writer)
+{
+    if (writer->records == 0)
+    {
+        return DKEDLIST_OK;
+    }
+
+    _put_u32_(writer->records, writer->buffer);
+    _put_u32_((uint32_t)(writer->used - CHUNK_HEADER_SIZE), writer->buffer + 4);
+
+    int code = _write_all_(writer->fd, writer->buffer, writer->used);
+
+    writer->used = CHUNK_HEADER_SIZE;
+    writer->records = 0;
+
+    return code;
+}
+
+void _put_record_(struct _dkedlist_codec_ *codec, void *data, unsigned long size, unsigned char *out)
+{
+    _put_u32_((uint32_t)size, out);
+    _put_u32_(0, out + 4);
+
+    codec->encode(data, out + RECORD_HEADER_SIZE);
+
+    memset(out + RECORD_HEADER_SIZE + size, 0, PADDED(size) - size);
+}
+
+int _write_large_record_(struct _serial_writer_ *writer, struct _dkedlist_codec_ *codec, void *data, unsigned long size)
+{
+    unsigned long total = CHUNK_HEADER_SIZE + RECORD_HEADER_SIZE + PADDED(size);
+    unsigned char *chunk = (unsigned char *)_dkedlist_allocate_(total);
+
+    if (!chunk)
+    {
+        return DKEDLIST_ERR_ALLOC;
+    }
+
+    _put_u32_(1, chunk);
+    _put_u32_((uint32_t)(total - CHUNK_HEADER_SIZE), chunk + 4);
+    _put_record_(codec, data, size, chunk + CHUNK_HEADER_SIZE);
+
+    int code = _write_all_(writer->fd, chunk, total);
+
+    _dkedlist_deallocate_(total, chunk);
+
+    return code;
+}
+
+int _write_record_(struct _serial_writer_ *writer, struct _dkedlist_codec_ *codec, void *data)
+{
+    unsigned long size = codec->size(data);
+
+    if (size > UINT32_MAX - CHUNK_HEADER_SIZE - RECORD_HEADER_SIZE - ALIGNMENT)
+    {
+        return DKEDLIST_ERR_FORMAT;
+    }
+
+    unsigned long need = RECORD_HEADER_SIZE + PADDED(size);
+
+    if (writer->used + need > DKEDLIST_SERIAL_BUFFER_SIZE)
+    {
+        int code = _flush_chunk_(writer);
+
+        if (code)
+        {
+            return code;
+        }
+    }
+
+    if (CHUNK_HEADER_SIZE + need > DKEDLIST_SERIAL_BUFFER_SIZE)
+    {
+        return _write_large_record_(writer, codec, data, size);
+    }
+
+    _put_record_(codec, data, size, writer->buffer + writer->used);
+
+    writer->used += need;
+    writer->records++;
+
+    return DKEDLIST_OK;
+}
+
+int _read_header_(const unsigned char *header, uint64_t *out_count)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        if (header[i] != magic[i])
+        {
+            return DKEDLIST_ERR_FORMAT;
+        }
+    }
+
+    if (_get_u32_(header + 4) != DKEDLIST_SERIAL_VERSION)
+    {
+        return DKEDLIST_ERR_FORMAT;
+    }
+
+    *out_count = _get_u64_(header + 8);
+
+    if (*out_count > ULONG_MAX)
+    {
+        return DKEDLIST_ERR_FORMAT;
+    }
+
+    return DKEDLIST_OK;
+}
+
+int _read_chunk_(const unsigned char *payload, uint32_t records, uint32_t length, struct _dkedlist_codec_ *codec, uint64_t count, struct _dkedlist_ *list)
+{
+    // Every record takes at least its header, so the count is bounded by bytes actually read
+    if (length % ALIGNMENT != 0 || records > length / RECORD_HEADER_SIZE || records > count - list->size)
+    {
+        return DKEDLIST_ERR_FORMAT;
+    }
+
+    // Grown geometrically, but never past the records still announced by the header
+    unsigned long reserve = list->size < count - list->size ? list->size : (unsigned long)(count - list->size);
+
+    if (dkedlist_reserve(reserve > records ? reserve : records, list))
+    {
+        return DKEDLIST_ERR_ALLOC;
+    }
+
+    const unsigned char *end = payload + length;
+
+    for (uint32_t i = 0; i < records; i++)
+    {
+        if ((unsigned long)(end - payload) < RECORD_HEADER_SIZE)
+        {
+            return DKEDLIST_ERR_FORMAT;
+        }
+
+        uint32_t size = _get_u32_(payload);
+
+        payload += RECORD_HEADER_SIZE;
+
+        if ((unsigned long)(end - payload) < PADDED((unsigned long)size))
+        {
+            return DKEDLIST_ERR_FORMAT;
+        }
+
+        void *data = NULL;
+
+        if (codec->decode(payload, size, &data))
+        {
+            return DKEDLIST_ERR_DECODE;
+        }
+
+        // Nodes were reserved above, so this can't fail
+        dkedlist_insert(data, list, NULL);
+
+        payload += PADDED((unsigned long)size);
+    }
+
+    return payload == end ? DKEDLIST_OK : DKEDLIST_ERR_FORMAT;
+}
+
+int _read_payload_(int fd, unsigned long length, unsigned char **buffer, unsigned long *capacity)
+{
+    unsigned long done = 0;
+
+    while (done < length)
+    {
+        // Grown only as bytes actually arrive, so a forged length can't force a huge allocation
+        if (done == *capacity)
+        {
+            unsigned long grown = *capacity > length - *capacity ? length : *capacity * 2;
+            unsigned char *bigger = (unsigned char *)_dkedlist_allocate_(grown);
+
+            if (!bigger)
+            {
+                return DKEDLIST_ERR_ALLOC;
+            }
+
+            memcpy(bigger, *buffer, done);
+            _dkedlist_deallocate_(*capacity, *buffer);
+
+            *buffer = bigger;
+            *capacity = grown;
+        }
+
+        unsigned long piece = (*capacity < length ? *capacity : length) - done;
+        int code = _read_all_(fd, *buffer + done, piece);
+
+        if (code)
+        {
+            return code;
+        }
+
+        done += piece;
+    }
+
+    return DKEDLIST_OK;
+}
+
+int dkedlist_serialize_fd(int fd, struct _dkedlist_codec_ *codec, struct _dkedlist_ *list)
+{
+    assert(codec && codec->size && codec->encode && "codec can't be NULL");
+
+    struct _serial_writer_ writer;
+    unsigned char header[HEADER_SIZE];
+
+    writer.buffer = (unsigned char *)_dkedlist_allocate_(DKEDLIST_SERIAL_BUFFER_SIZE);
+
+    if (!writer.buffer)
+    {
+        return DKEDLIST_ERR_ALLOC;
+    }
+
+    writer.fd = fd;
+    writer.used = CHUNK_HEADER_SIZE;
+    writer.records = 0;
+
+    header[0] = magic[0];
+    header[1] = magic[1];
+    header[2] = magic[2];
+    header[3] = magic[3];
+    _put_u32_(DKEDLIST_SERIAL_VERSION, header + 4);
+    _put_u64_(list->size, header + 8);
+
+    int code = _write_all_(fd, header, HEADER_SIZE);
+
+    for (struct _dkedlist_node_ *node = list->head; node && !code; node = node->next)
+    {
+        code = _write_record_(&writer, codec, node->data);
+    }
+
+    if (!code)
+    {
+        code = _flush_chunk_(&writer);
+    }
+
+    if (!code)
+    {
+        // Empty chunk marking the end of the snapshot
+        _put_u32_(0, writer.buffer);
+        _put_u32_(0, writer.buffer + 4);
+
+        code = _write_all_(fd, writer.buffer, CHUNK_HEADER_SIZE);
+    }
+
+    _dkedlist_deallocate_(DKEDLIST_SERIAL_BUFFER_SIZE, writer.buffer);
+
+    return code;
+}
+
+int dkedlist_deserialize_fd(int fd, void (*destroy_data)(void *data), struct _dkedlist_codec_ *codec, struct _dkedlist_ **out_list)
+{
+    assert(codec && codec->decode && "codec can't be NULL");
+
+    unsigned char header[HEADER_SIZE];
+    uint64_t count = 0;
+    struct _dkedlist_ *list = NULL;
+
+    int code = _read_all_(fd, header, HEADER_SIZE);
+
+    if (!code)
+    {
+        code = _read_header_(header, &count);
+    }
+
+    if (code)
+    {
+        return code;
+    }
+
+    if (dkedlist_create(destroy_data, &list))
+    {
+        return DKEDLIST_ERR_ALLOC;
+    }
+
+    // Payloads are read at the start of the buffer, keeping records aligned
+    unsigned long capacity = DKEDLIST_SERIAL_BUFFER_SIZE;
+    unsigned char *buffer = (unsigned char *)_dkedlist_allocate_(capacity);
+
+    if (!buffer)
+    {
+        dkedlist_destroy(&list);
+        return DKEDLIST_ERR_ALLOC;
+    }
+
+    for (;;)
+    {
+        unsigned char chunk_header[CHUNK_HEADER_SIZE];
+
+        code = _read_all_(fd, chunk_header, CHUNK_HEADER_SIZE);
+
+        if (code)
+        {
+            break;
+        }
+
+        uint32_t records = _get_u32_(chunk_header);
+        uint32_t length = _get_u32_(chunk_header + 4);
+
+        if (records == 0)
+        {
+            code = length == 0 && list->size == count ? DKEDLIST_OK : DKEDLIST_ERR_FORMAT;
+            break;
+        }
+
+        // Only a chunk holding a single large record can outgrow the buffer
+        if (length > capacity && records != 1)
+        {
+            code = DKEDLIST_ERR_FORMAT;
+            break;
+        }
+
+        code = _read_payload_(fd, length, &buffer, &capacity);
+
+        if (!code)
+        {
+            code = _read_chunk_(buffer, records, length, codec, count, list);
+        }
+
+        if (code)
+        {
+            break;
+        }
+    }
+
+    _dkedlist_deallocate_(capacity, buffer);
+
+    if (code)
+    {
+        dkedlist_destroy_clean(&list);
+        return code;
+    }
+
+    *out_list = list;
+
+    return DKEDLIST_OK;
+}
+
+int dkedlist_deserialize_region(const void *region, unsigned long length, void (*destroy_data)(void *data), struct _dkedlist_codec_ *codec, struct _dkedlist_ **out_list)
+{
+    assert(region && "region can't be NULL");
+    assert(codec && codec->decode && "codec can't be NULL");
+
+    const unsigned char *current = (const unsigned char *)region;
+    const unsigned char *end = current + length;
+    uint64_t count = 0;
+    struct _dkedlist_ *list = NULL;
+
+    if (length < HEADER_SIZE)
+    {
+        return DKEDLIST_ERR_FORMAT;
+    }
+
+    int code = _read_header_(current, &count);
+
+    // Every record takes at least its header
+    if (!code && count > (length - HEADER_SIZE) / RECORD_HEADER_SIZE)
+    {
+        code = DKEDLIST_ERR_FORMAT;
+    }
+
+    if (code)
+    {
+        return code;
+    }
+
+    if (dkedlist_create(destroy_data, &list))
+    {
+        return DKEDLIST_ERR_ALLOC;
+    }
+
+    current += HEADER_SIZE;
+
+    for (;;)
+    {
+        if ((unsigned long)(end - current) < CHUNK_HEADER_SIZE)
+        {
+            code = DKEDLIST_ERR_FORMAT;
+            break;
+        }
+
+        uint32_t records = _get_u32_(current);
+        uint32_t chunk_length = _get_u32_(current + 4);
+
+        current += CHUNK_HEADER_SIZE;
+
+        if (records == 0)
+        {
+            code = chunk_length == 0 && list->size == count ? DKEDLIST_OK : DKEDLIST_ERR_FORMAT;
+            break;
+        }
+
+        if ((unsigned long)(end - current) < chunk_length)
+        {
+            code = DKEDLIST_ERR_FORMAT;
+            break;
+        }
+
+        code = _read_chunk_(current, records, chunk_length, codec, count, list);
+
+        if (code)
+        {
+            break;
+        }
+
+        current += chunk_length;
+    }
+
+    if (code)
+    {
+        dkedlist_destroy_clean(&list);
+        return code;
+    }
+
+    *out_list = list;
+
+    return DKEDLIST_OK;
+}
@@ -0,0 +1,94 @@
+// DkedList 1.1.0
+
+#ifndef _DKEDLIST_SERIAL_H_
+#define _DKEDLIST_SERIAL_H_
+
+#include "dkedlist.h"
+
+/*
+ * On-disk format (every integer is little-endian):
+ *
+ *   header: "DKDL" magic (4 bytes), format version (u32), numbers of records (u64)
+ *   chunk:  numbers of records (u32), payload length in bytes (u32), payload
+ *   record: record length in bytes (u32), reserved (u32, 0), record bytes,
+ *           zero padding up to a multiple of 8 bytes
+ *
+ * Chunks follow the header one after another, and the last one is an empty
+ * chunk (0 records, 0 bytes) marking the end of the snapshot. Headers and
+ * padding keep every record at an offset multiple of 8 from the start of
+ * the snapshot.
+ */
+
+#define DKEDLIST_SERIAL_VERSION 1
+
+#ifndef DKEDLIST_SERIAL_BUFFER_SIZE
+#define DKEDLIST_SERIAL_BUFFER_SIZE 65536
+#endif
+
+/**
+ * @brief Functions used to turn the data inserted in the list
+ * into records and back.
+ *
+ */
+struct _dkedlist_codec_
+{
+    unsigned long (*size)(void *data);                  // Returns the numbers of bytes encode will write for the data.
+    void (*encode)(void *data, unsigned char *record);  // Writes the data into the record, which has room for exactly size(data) bytes.
+    int (*decode)(const unsigned char *record, unsigned long size, void **out_data); // Creates the data from the record, which is 8 bytes aligned. Returns 0 on success.
+};
+
+typedef struct _dkedlist_codec_ DkedListCodec;
+
+/**
+ * @brief Writes the list to a file descriptor. Records are encoded into
+ * a buffer of DKEDLIST_SERIAL_BUFFER_SIZE bytes which is written as a chunk
+ * every time it fills up, so the list is never staged in memory as a whole.
+ *
+ * @param fd File descriptor opened for writing.
+ * @param codec Pointer to the codec. size and encode must not be NULL.
+ * @param list Pointer to the list. Must not be NULL.
+ * @return DKEDLIST_ERR_ALLOC if allocation error happens. DKEDLIST_ERR_IO if
+ * writing fails. DKEDLIST_ERR_FORMAT if a record is bigger than 4GiB. DKEDLIST_OK otherwise.
+ */
+int dkedlist_serialize_fd(int fd, struct _dkedlist_codec_ *codec, struct _dkedlist_ *list);
+
+/**
+ * @brief Creates a new list from a snapshot read from a file descriptor.
+ * Nodes are created in bulk as chunks are read. Neither the record count of
+ * the header nor the length of a chunk is trusted beyond the data actually
+ * read. Records passed to decode live in a temporary buffer, so they must be
+ * copied if needed.
+ *
+ * @param fd File descriptor opened for reading, positioned at the snapshot header.
+ * @param destroy_data Pointer to a function used to help deallocate
+ * memory allocated data inserted in the list (if any). Can be NULL.
+ * @param codec Pointer to the codec. decode must not be NULL.
+ * @param out_list Pointer to a pointer where the created list will
+ * be passed. Must not be NULL.
+ * @return DKEDLIST_ERR_ALLOC if allocation error happens. DKEDLIST_ERR_IO if
+ * reading fails. DKEDLIST_ERR_FORMAT if the snapshot is malformed or truncated.
+ * DKEDLIST_ERR_DECODE if decode fails. DKEDLIST_OK otherwise.
+ */
+int dkedlist_deserialize_fd(int fd, void (*destroy_data)(void *data), struct _dkedlist_codec_ *codec, struct _dkedlist_ **out_list);
+
+/**
+ * @brief Creates a new list from a snapshot stored in memory, for example a
+ * mmap'd file. Nodes are created in bulk as chunks are read. Records passed to
+ * decode point straight into the region, so decode can use them as data without
+ * copying as long as the region outlives the list. The region may be read only.
+ *
+ * @param region Pointer to the start of the snapshot. Should be 8 bytes aligned,
+ * as mappings are, for records to be aligned too. Must not be NULL.
+ * @param length Size of the region in bytes.
+ * @param destroy_data Pointer to a function used to help deallocate
+ * memory allocated data inserted in the list (if any). Can be NULL.
+ * @param codec Pointer to the codec. decode must not be NULL.
+ * @param out_list Pointer to a pointer where the created list will
+ * be passed. Must not be NULL.
+ * @return DKEDLIST_ERR_ALLOC if allocation error happens. DKEDLIST_ERR_FORMAT if
+ * the snapshot is malformed or truncated. DKEDLIST_ERR_DECODE if decode fails.
+ * DKEDLIST_OK otherwise.
+ */
+int dkedlist_deserialize_region(const void *region, unsigned long length, void (*destroy_data)(void *data), struct _dkedlist_codec_ *codec, struct _dkedlist_ **out_list);
+
+#endif